@@ -5,18 +5,332 @@
 #include <ctime>
 #include <cstdlib>
 #include <chrono>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <random>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <atomic>
+#include <new>
+#include <cstddef>
+#if defined(_WIN32) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include <cstdint>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOOM_SSE2
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A MemoryStats must outlive every block allocated while it was current:
+// frees are charged to the owner recorded in the block header, even after
+// the MemoryScope that installed it has ended.
+struct MemoryStats {
+    std::atomic<long long> liveBytes;
+    std::atomic<long long> liveBlocks;
+    std::atomic<long long> usableBytes;
+    std::atomic<long long> peakBytes;
+    std::atomic<long long> allocations;
+
+    MemoryStats() : liveBytes(0), liveBlocks(0), usableBytes(0), peakBytes(0), allocations(0) {}
+
+    void onAllocate(size_t size, size_t usable) {
+        long long live = liveBytes += static_cast<long long>(size);
+        liveBlocks++;
+        usableBytes += static_cast<long long>(usable);
+        allocations++;
+        long long peak = peakBytes.load();
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+    }
+
+    void onRelease(size_t size, size_t usable) {
+        liveBytes -= static_cast<long long>(size);
+        liveBlocks--;
+        usableBytes -= static_cast<long long>(usable);
+    }
+};
+
+thread_local MemoryStats* currentMemoryStats = nullptr;
+
+class MemoryScope {
+private:
+    MemoryStats* previous;
+public:
+    MemoryScope(MemoryStats& stats) : previous(currentMemoryStats) {
+        currentMemoryStats = &stats;
+    }
+
+    ~MemoryScope() {
+        currentMemoryStats = previous;
+    }
+};
+
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+    MemoryStats* owner;
+    size_t size;
+};
+
+size_t usableSize(void* block, size_t requested) {
+#if defined(_WIN32)
+    (void)requested;
+    return _msize(block);
+#elif defined(__GLIBC__)
+    (void)requested;
+    return malloc_usable_size(block);
+#else
+    (void)block;
+    return (requested + 15) & ~static_cast<size_t>(15);
+#endif
+}
+
+void* trackedAllocate(size_t size) {
+    void* block = std::malloc(sizeof(AllocationHeader) + size);
+    if (!block) return nullptr;
+    AllocationHeader* header = static_cast<AllocationHeader*>(block);
+    header->owner = currentMemoryStats;
+    header->size = size;
+    if (header->owner) {
+        header->owner->onAllocate(size, usableSize(block, sizeof(AllocationHeader) + size) - sizeof(AllocationHeader));
+    }
+    return header + 1;
+}
+
+void trackedRelease(void* ptr) {
+    if (!ptr) return;
+    AllocationHeader* header = static_cast<AllocationHeader*>(ptr) - 1;
+    if (header->owner) {
+        header->owner->onRelease(header->size,
+            usableSize(header, sizeof(AllocationHeader) + header->size) - sizeof(AllocationHeader));
+    }
+    std::free(header);
+}
+
+void* operator new(size_t size) {
+    void* ptr = trackedAllocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    void* ptr = trackedAllocate(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    trackedRelease(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    trackedRelease(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    trackedRelease(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    trackedRelease(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    trackedRelease(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    trackedRelease(ptr);
+}
+
+size_t peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void printMemory(const MemoryStats& stats, int keys) {
+    long long live = stats.liveBytes.load();
+    long long usable = stats.usableBytes.load();
+    std::cout << "    memory: " << live << " live bytes in " << stats.liveBlocks.load() << " blocks ("
+        << stats.allocations.load() << " allocations, peak " << stats.peakBytes.load() << " bytes)";
+    if (keys > 0) {
+        std::cout << ", " << static_cast<double>(usable) / keys << " bytes/key";
+    }
+    if (usable > 0) {
+        std::cout << ", fragmentation " << 100.0 * (usable - live) / usable << "%";
+    }
+    std::cout << "\n";
+}
+
+std::mt19937& randomEngine() {
+    thread_local std::mt19937 engine(static_cast<unsigned int>(time(0)) ^
+        static_cast<unsigned int>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+    return engine;
+}
 
 std::string generateRandomString() {
     std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     std::string result;
-    int length = rand() % 5 + 1;
+    std::mt19937& engine = randomEngine();
+    int length = engine() % 5 + 1;
     for (int i = 0; i < length; i++) {
-        result += chars[rand() % chars.length()];
+        result += chars[engine() % chars.length()];
     }
     return result;
 }
 
 
+class BloomFilter {
+private:
+    static const size_t blockWords = 8;
+    static const size_t bitsPerKey = 10;
+
+    std::vector<uint64_t> storage;
+    size_t offset;
+    size_t blockCount;
+    size_t capacity;
+    size_t inserted;
+    size_t removed;
+
+    static uint64_t hash(const std::string& value) {
+        uint64_t h = std::hash<std::string>()(value);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    size_t blockStart(uint64_t h) const {
+        return offset + static_cast<size_t>((h >> 32) % blockCount) * blockWords;
+    }
+
+    static void makeMask(uint64_t h, uint64_t mask[blockWords]) {
+        static const uint32_t salts[blockWords] = {
+            0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+            0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+        };
+        uint32_t key = static_cast<uint32_t>(h);
+        for (size_t i = 0; i < blockWords; i++) {
+            mask[i] = 1ULL << ((key * salts[i]) >> 26);
+        }
+    }
+
+public:
+    BloomFilter() : offset(0), blockCount(0), capacity(0), inserted(0), removed(0) {}
+
+    bool enabled() const {
+        return blockCount != 0;
+    }
+
+    void reset(size_t expectedKeys) {
+        capacity = std::max<size_t>(expectedKeys * 2, 1024);
+        blockCount = (capacity * bitsPerKey + 511) / 512;
+        storage.assign(blockCount * blockWords + blockWords, 0);
+        size_t address = reinterpret_cast<size_t>(storage.data());
+        offset = ((64 - address % 64) % 64) / sizeof(uint64_t);
+        inserted = 0;
+        removed = 0;
+    }
+
+    void disable() {
+        std::vector<uint64_t>().swap(storage);
+        blockCount = 0;
+    }
+
+    void insert(const std::string& value) {
+        uint64_t h = hash(value);
+        uint64_t mask[blockWords];
+        makeMask(h, mask);
+        uint64_t* words = storage.data() + blockStart(h);
+        for (size_t i = 0; i < blockWords; i++) {
+            words[i] |= mask[i];
+        }
+        inserted++;
+    }
+
+    bool mayContain(const std::string& value) const {
+        uint64_t h = hash(value);
+        uint64_t mask[blockWords];
+        makeMask(h, mask);
+        const uint64_t* words = storage.data() + blockStart(h);
+#ifdef BLOOM_SSE2
+        __m128i missing = _mm_setzero_si128();
+        for (size_t i = 0; i < blockWords; i += 2) {
+            __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+            __m128i wanted = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+            missing = _mm_or_si128(missing, _mm_andnot_si128(bits, wanted));
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+        uint64_t missing = 0;
+        for (size_t i = 0; i < blockWords; i++) {
+            missing |= mask[i] & ~words[i];
+        }
+        return missing == 0;
+#endif
+    }
+
+    void noteRemove() {
+        removed++;
+    }
+
+    bool needsRebuild() const {
+        return inserted > capacity || removed > capacity / 4;
+    }
+
+    size_t bytes() const {
+        return blockCount * blockWords * sizeof(uint64_t);
+    }
+
+    template <typename ForEachKey>
+    void rebuild(ForEachKey forEachKey) {
+        size_t count = 0;
+        auto counter = [&count](const std::string&) { count++; };
+        forEachKey(counter);
+        reset(count);
+        auto inserter = [this](const std::string& key) { insert(key); };
+        forEachKey(inserter);
+    }
+};
+
+
 struct Node {
     std::string data;
     Node* next;
@@ -26,8 +340,23 @@ struct Node {
 class LinkedList {
 private:
     Node* head;
+    Node* finger;
+    bool fingerEnabled;
+    BloomFilter bloom;
+
+    template <typename F>
+    void forEachKey(F& visit) {
+        for (Node* current = head; current; current = current->next) {
+            visit(current->data);
+        }
+    }
+
+    void rebuildBloom() {
+        bloom.rebuild([this](auto& visit) { forEachKey(visit); });
+    }
+
 public:
-    LinkedList() : head(nullptr) {}
+    LinkedList() : head(nullptr), finger(nullptr), fingerEnabled(false) {}
 
     ~LinkedList() {
         while (head) {
@@ -37,27 +366,47 @@ public:
         }
     }
 
+    void setFinger(bool enabled) {
+        fingerEnabled = enabled;
+        finger = nullptr;
+    }
+
     void add(std::string value) {
+        Node* inserted = add(value, fingerEnabled ? finger : nullptr);
+        if (fingerEnabled) finger = inserted;
+    }
+
+    Node* add(std::string value, Node* hint) {
         Node* newNode = new Node(value);
         if (!head || head->data > value) {
             newNode->next = head;
             head = newNode;
         }
         else {
-            Node* current = head;
+            Node* current = hint && hint->data <= value ? hint : head;
             while (current->next && current->next->data <= value) {
                 current = current->next;
             }
             newNode->next = current->next;
             current->next = newNode;
         }
+        if (bloom.enabled()) {
+            bloom.insert(value);
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
+        return newNode;
     }
 
     void remove(std::string value) {
+        if (bloom.enabled()) {
+            bloom.noteRemove();
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
         if (!head) return;
         if (head->data == value) {
             Node* temp = head;
             head = head->next;
+            if (temp == finger) finger = nullptr;
             delete temp;
             return;
         }
@@ -68,11 +417,13 @@ public:
         if (current->next) {
             Node* temp = current->next;
             current->next = current->next->next;
+            if (temp == finger) finger = nullptr;
             delete temp;
         }
     }
 
     bool search(std::string value) {
+        if (bloom.enabled() && !bloom.mayContain(value)) return false;
         Node* current = head;
         while (current) {
             if (current->data == value) return true;
@@ -81,6 +432,24 @@ public:
         return false;
     }
 
+    std::vector<bool> searchSorted(const std::vector<std::string>& batch) {
+        std::vector<bool> found(batch.size(), false);
+        std::vector<size_t> order(batch.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return batch[a] < batch[b]; });
+
+        Node* current = head;
+        for (size_t index : order) {
+            while (current && current->data < batch[index]) {
+                current = current->next;
+            }
+            found[index] = current && current->data == batch[index];
+        }
+        return found;
+    }
+
     void print() {
         Node* current = head;
         while (current) {
@@ -95,19 +464,192 @@ public:
             add(generateRandomString());
         }
     }
+
+    void enableBloom(bool enabled) {
+        if (enabled) {
+            rebuildBloom();
+        }
+        else {
+            bloom.disable();
+        }
+    }
+
+    const BloomFilter& bloomFilter() const {
+        return bloom;
+    }
 };
 
 
 class ArrayList {
 private:
+    static const size_t blockSize = 16;
+
     std::vector<std::string> list;
+    std::vector<unsigned char> frontCoded;
+    std::vector<size_t> blockOffsets;
+    size_t compressedCount;
+    bool compressed;
+    BloomFilter bloom;
+
+    void writeVarint(size_t value) {
+        while (value >= 0x80) {
+            frontCoded.push_back(static_cast<unsigned char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        frontCoded.push_back(static_cast<unsigned char>(value));
+    }
+
+    size_t readVarint(const unsigned char*& p) const {
+        size_t value = 0;
+        for (int shift = 0; ; shift += 7) {
+            unsigned char byte = *p++;
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    size_t blockKeys(size_t block) const {
+        size_t remaining = compressedCount - block * blockSize;
+        return remaining < blockSize ? remaining : blockSize;
+    }
+
+    template <typename F>
+    bool decodeBlock(size_t block, std::string& current, F visit) const {
+        const unsigned char* p = frontCoded.data() + blockOffsets[block];
+        size_t length = readVarint(p);
+        current.assign(reinterpret_cast<const char*>(p), length);
+        p += length;
+        if (!visit(current)) return false;
+        for (size_t i = 1; i < blockKeys(block); i++) {
+            size_t shared = readVarint(p);
+            size_t suffix = readVarint(p);
+            current.resize(shared);
+            current.append(reinterpret_cast<const char*>(p), suffix);
+            p += suffix;
+            if (!visit(current)) return false;
+        }
+        return true;
+    }
+
+    int compareHead(size_t block, const std::string& value) const {
+        const unsigned char* p = frontCoded.data() + blockOffsets[block];
+        size_t length = readVarint(p);
+        return -value.compare(0, std::string::npos, reinterpret_cast<const char*>(p), length);
+    }
+
+    bool searchCompressed(const std::string& value) const {
+        size_t low = 0;
+        size_t high = blockOffsets.size();
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (compareHead(mid, value) <= 0) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        if (low == 0) return false;
+
+        bool found = false;
+        std::string current;
+        decodeBlock(low - 1, current, [&](const std::string& key) {
+            if (key == value) found = true;
+            return !found && key < value;
+        });
+        return found;
+    }
+
+    template <typename F>
+    void forEachKey(F& visit) {
+        if (!compressed) {
+            for (const auto& key : list) {
+                visit(key);
+            }
+            return;
+        }
+        std::string current;
+        for (size_t block = 0; block < blockOffsets.size(); block++) {
+            decodeBlock(block, current, [&](const std::string& key) {
+                visit(key);
+                return true;
+            });
+        }
+    }
+
+    void rebuildBloom() {
+        bloom.rebuild([this](auto& visit) { forEachKey(visit); });
+    }
+
 public:
+    ArrayList() : compressedCount(0), compressed(false) {}
+
+    void compress() {
+        if (compressed) return;
+        frontCoded.clear();
+        blockOffsets.clear();
+        for (size_t i = 0; i < list.size(); i++) {
+            if (i % blockSize == 0) {
+                blockOffsets.push_back(frontCoded.size());
+                writeVarint(list[i].size());
+                frontCoded.insert(frontCoded.end(), list[i].begin(), list[i].end());
+                continue;
+            }
+            const std::string& previous = list[i - 1];
+            size_t shared = 0;
+            while (shared < previous.size() && shared < list[i].size() && previous[shared] == list[i][shared]) {
+                shared++;
+            }
+            writeVarint(shared);
+            writeVarint(list[i].size() - shared);
+            frontCoded.insert(frontCoded.end(), list[i].begin() + shared, list[i].end());
+        }
+        frontCoded.shrink_to_fit();
+        blockOffsets.shrink_to_fit();
+        compressedCount = list.size();
+        std::vector<std::string>().swap(list);
+        compressed = true;
+    }
+
+    void decompress() {
+        if (!compressed) return;
+        list.reserve(compressedCount);
+        std::string current;
+        for (size_t block = 0; block < blockOffsets.size(); block++) {
+            decodeBlock(block, current, [&](const std::string& key) {
+                list.push_back(key);
+                return true;
+            });
+        }
+        std::vector<unsigned char>().swap(frontCoded);
+        std::vector<size_t>().swap(blockOffsets);
+        compressedCount = 0;
+        compressed = false;
+    }
+
+    bool isCompressed() const {
+        return compressed;
+    }
+
+    void shrinkToFit() {
+        list.shrink_to_fit();
+    }
+
     void add(std::string value) {
-        list.push_back(value);
-        std::sort(list.begin(), list.end());
+        decompress();
+        list.insert(std::upper_bound(list.begin(), list.end(), value), value);
+        if (bloom.enabled()) {
+            bloom.insert(value);
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
     }
 
     void remove(std::string value) {
+        if (bloom.enabled()) {
+            bloom.noteRemove();
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
+        decompress();
         auto it = std::find(list.begin(), list.end(), value);
         if (it != list.end()) {
             list.erase(it);
@@ -115,10 +657,52 @@ public:
     }
 
     bool search(std::string value) {
+        if (bloom.enabled() && !bloom.mayContain(value)) return false;
+        if (compressed) return searchCompressed(value);
         return std::binary_search(list.begin(), list.end(), value);
     }
 
+    std::vector<bool> searchSorted(const std::vector<std::string>& batch) {
+        std::vector<bool> found(batch.size(), false);
+        if (compressed) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                found[i] = searchCompressed(batch[i]);
+            }
+            return found;
+        }
+        std::vector<size_t> order(batch.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return batch[a] < batch[b]; });
+
+        size_t position = 0;
+        for (size_t index : order) {
+            const std::string& key = batch[index];
+            size_t bound = 1;
+            while (position + bound < list.size() && list[position + bound] < key) {
+                bound *= 2;
+            }
+            auto first = list.begin() + (position + bound / 2);
+            auto last = list.begin() + std::min(position + bound + 1, list.size());
+            position = std::lower_bound(first, last, key) - list.begin();
+            found[index] = position < list.size() && list[position] == key;
+        }
+        return found;
+    }
+
     void print() {
+        if (compressed) {
+            std::string current;
+            for (size_t block = 0; block < blockOffsets.size(); block++) {
+                decodeBlock(block, current, [](const std::string& key) {
+                    std::cout << key << " ";
+                    return true;
+                });
+            }
+            std::cout << std::endl;
+            return;
+        }
         for (const auto& val : list) {
             std::cout << val << " ";
         }
@@ -130,6 +714,19 @@ public:
             add(generateRandomString());
         }
     }
+
+    void enableBloom(bool enabled) {
+        if (enabled) {
+            rebuildBloom();
+        }
+        else {
+            bloom.disable();
+        }
+    }
+
+    const BloomFilter& bloomFilter() const {
+        return bloom;
+    }
 };
 
 
@@ -143,6 +740,20 @@ struct BSTNode {
 class BinarySearchTree {
 private:
     BSTNode* root;
+    BloomFilter bloom;
+
+    template <typename F>
+    void forEachKey(BSTNode* node, F& visit) {
+        if (node) {
+            forEachKey(node->left, visit);
+            visit(node->data);
+            forEachKey(node->right, visit);
+        }
+    }
+
+    void rebuildBloom() {
+        bloom.rebuild([this](auto& visit) { forEachKey(root, visit); });
+    }
 
     BSTNode* add(BSTNode* node, std::string value) {
         if (!node) return new BSTNode(value);
@@ -224,13 +835,22 @@ public:
 
     void add(std::string value) {
         root = add(root, value);
+        if (bloom.enabled()) {
+            bloom.insert(value);
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
     }
 
     void remove(std::string value) {
         root = remove(root, value);
+        if (bloom.enabled()) {
+            bloom.noteRemove();
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
     }
 
     bool search(std::string value) {
+        if (bloom.enabled() && !bloom.mayContain(value)) return false;
         return search(root, value);
     }
 
@@ -244,6 +864,19 @@ public:
             add(generateRandomString());
         }
     }
+
+    void enableBloom(bool enabled) {
+        if (enabled) {
+            rebuildBloom();
+        }
+        else {
+            bloom.disable();
+        }
+    }
+
+    const BloomFilter& bloomFilter() const {
+        return bloom;
+    }
 };
 
 struct AVLNode {
@@ -257,6 +890,29 @@ struct AVLNode {
 class AVLTree {
 private:
     AVLNode* root;
+    BloomFilter bloom;
+    bool fingerEnabled;
+    std::vector<AVLNode*> fingerPath;
+    std::vector<const std::string*> fingerLower;
+    std::vector<const std::string*> fingerUpper;
+
+    template <typename F>
+    void forEachKey(AVLNode* node, F& visit) {
+        if (node) {
+            forEachKey(node->left, visit);
+            visit(node->data);
+            forEachKey(node->right, visit);
+        }
+    }
+
+    void rebuildBloom() {
+        bloom.rebuild([this](auto& visit) { forEachKey(root, visit); });
+    }
+
+    void resetDerivedState() {
+        fingerPath.clear();
+        if (bloom.enabled()) rebuildBloom();
+    }
 
     int height(AVLNode* node) {
         return node ? node->height : 0;
@@ -372,356 +1028,1718 @@ private:
         }
     }
 
-public:
-    AVLTree() : root(nullptr) {}
-
-    ~AVLTree() {
-        deleteTree(root);
-    }
-
-    void deleteTree(AVLNode* node) {
-        if (node) {
-            deleteTree(node->left);
-            deleteTree(node->right);
-            delete node;
+    AVLNode* joinRight(AVLNode* left, AVLNode* middle, AVLNode* right) {
+        if (height(left) <= height(right) + 1) {
+            middle->left = left;
+            middle->right = right;
+            updateHeight(middle);
+            return middle;
         }
+        left->right = joinRight(left->right, middle, right);
+        return balance(left);
     }
 
-    void add(std::string value) {
-        root = add(root, value);
+    AVLNode* joinLeft(AVLNode* left, AVLNode* middle, AVLNode* right) {
+        if (height(right) <= height(left) + 1) {
+            middle->left = left;
+            middle->right = right;
+            updateHeight(middle);
+            return middle;
+        }
+        right->left = joinLeft(left, middle, right->left);
+        return balance(right);
     }
 
-    void remove(std::string value) {
-        root = remove(root, value);
+    AVLNode* join(AVLNode* left, AVLNode* middle, AVLNode* right) {
+        if (height(left) > height(right) + 1) {
+            return joinRight(left, middle, right);
+        }
+        return joinLeft(left, middle, right);
     }
 
-    bool search(std::string value) {
-        return search(root, value);
+    AVLNode* splitLast(AVLNode* node, AVLNode*& last) {
+        if (!node->right) {
+            AVLNode* rest = node->left;
+            node->left = nullptr;
+            node->height = 1;
+            last = node;
+            return rest;
+        }
+        AVLNode* rest = splitLast(node->right, last);
+        return join(node->left, node, rest);
     }
 
-    void print() {
-        inorder(root);
-        std::cout << std::endl;
+    AVLNode* join(AVLNode* left, AVLNode* right) {
+        if (!left) return right;
+        AVLNode* last;
+        AVLNode* rest = splitLast(left, last);
+        return join(rest, last, right);
     }
 
-    void fillRandom(int n) {
-        for (int i = 0; i < n; i++) {
-            add(generateRandomString());
+    AVLNode* split(AVLNode* node, const std::string& key, AVLNode*& left, AVLNode*& right) {
+        if (!node) {
+            left = right = nullptr;
+            return nullptr;
         }
+        AVLNode* nodeLeft = node->left;
+        AVLNode* nodeRight = node->right;
+        if (key == node->data) {
+            left = nodeLeft;
+            right = nodeRight;
+            node->left = node->right = nullptr;
+            node->height = 1;
+            return node;
+        }
+        if (key < node->data) {
+            AVLNode* greater;
+            AVLNode* found = split(nodeLeft, key, left, greater);
+            right = join(greater, node, nodeRight);
+            return found;
+        }
+        AVLNode* less;
+        AVLNode* found = split(nodeRight, key, less, right);
+        left = join(nodeLeft, node, less);
+        return found;
     }
-};
-
-
-struct TTNode {
-    std::string data1, data2;
-    TTNode* left;
-    TTNode* middle;
-    TTNode* right;
-    TTNode* parent;
-
-    TTNode(std::string value) : data1(value), left(nullptr), middle(nullptr), right(nullptr), parent(nullptr) {}
 
-    bool isLeaf() {
-        return left == nullptr && middle == nullptr && right == nullptr;
+    template <typename F, typename G>
+    void forkJoin(bool fork, F first, G second) {
+        if (!fork) {
+            first();
+            second();
+            return;
+        }
+        auto pending = std::async(std::launch::async, first);
+        second();
+        pending.get();
     }
 
-    bool hasTwoKeys() {
-        return !data2.empty();
+    bool shouldFork(AVLNode* a, AVLNode* b, int forkDepth) {
+        return forkDepth > 0 && height(a) >= 12 && height(b) >= 12;
     }
 
-    bool hasOneKey() {
-        return !data1.empty() && data2.empty();
+    AVLNode* unionWith(AVLNode* a, AVLNode* b, int forkDepth) {
+        if (!a) return b;
+        if (!b) return a;
+        bool fork = shouldFork(a, b, forkDepth);
+        AVLNode* aLeft = a->left;
+        AVLNode* aRight = a->right;
+        AVLNode* bLeft;
+        AVLNode* bRight;
+        delete split(b, a->data, bLeft, bRight);
+
+        AVLNode* left;
+        AVLNode* right;
+        forkJoin(fork,
+            [&] { left = unionWith(aLeft, bLeft, forkDepth - 1); },
+            [&] { right = unionWith(aRight, bRight, forkDepth - 1); });
+        return join(left, a, right);
     }
-};
-
-class TwoThreeTree {
-private:
-    TTNode* root;
 
-    void insertIntoNode(TTNode* node, const std::string& value, TTNode* left, TTNode* right) {
-        if (node->data1.empty()) {
-            node->data1 = value;
-            node->left = left;
-            node->middle = right;
-        }
-        else if (value < node->data1) {
-            node->data2 = node->data1;
-            node->data1 = value;
-            node->right = node->middle;
-            node->left = left;
-            node->middle = right;
+    AVLNode* intersect(AVLNode* a, AVLNode* b, int forkDepth) {
+        if (!a || !b) {
+            deleteTree(a);
+            deleteTree(b);
+            return nullptr;
         }
-        else {
-            node->data2 = value;
-            node->middle = left;
-            node->right = right;
+        bool fork = shouldFork(a, b, forkDepth);
+        AVLNode* aLeft = a->left;
+        AVLNode* aRight = a->right;
+        AVLNode* bLeft;
+        AVLNode* bRight;
+        AVLNode* found = split(b, a->data, bLeft, bRight);
+
+        AVLNode* left;
+        AVLNode* right;
+        forkJoin(fork,
+            [&] { left = intersect(aLeft, bLeft, forkDepth - 1); },
+            [&] { right = intersect(aRight, bRight, forkDepth - 1); });
+        if (found) {
+            delete found;
+            return join(left, a, right);
         }
-
-        if (left) left->parent = node;
-        if (right) right->parent = node;
+        delete a;
+        return join(left, right);
     }
 
-    void split(TTNode* node) {
-        TTNode* parent = node->parent;
-        TTNode* left = new TTNode(node->data1);
-        TTNode* right = new TTNode(node->data2);
-
-        left->left = node->left;
-        left->middle = node->middle;
-        right->left = node->middle;
-        right->middle = node->right;
-
-        if (left->left) left->left->parent = left;
-        if (left->middle) left->middle->parent = left;
-        if (right->left) right->left->parent = right;
-        if (right->middle) right->middle->parent = right;
-
-        if (parent) {
-            insertIntoNode(parent, node->data1, left, right);
-            if (parent->hasTwoKeys()) split(parent);
+    AVLNode* difference(AVLNode* a, AVLNode* b, int forkDepth) {
+        if (!a || !b) {
+            deleteTree(b);
+            return a;
         }
-        else {
-            root = new TTNode(node->data1);
-            root->left = left;
-            root->middle = right;
-            left->parent = root;
-            right->parent = root;
+        bool fork = shouldFork(a, b, forkDepth);
+        AVLNode* bLeft = b->left;
+        AVLNode* bRight = b->right;
+        AVLNode* aLeft;
+        AVLNode* aRight;
+        delete split(a, b->data, aLeft, aRight);
+        delete b;
+
+        AVLNode* left;
+        AVLNode* right;
+        forkJoin(fork,
+            [&] { left = difference(aLeft, bLeft, forkDepth - 1); },
+            [&] { right = difference(aRight, bRight, forkDepth - 1); });
+        return join(left, right);
+    }
+
+    int forkDepth(unsigned threads) {
+        int depth = 0;
+        while ((1u << depth) < threads) {
+            depth++;
         }
+        return depth;
+    }
 
-        delete node;
+    AVLNode* buildBalanced(std::vector<std::string>& keys, size_t begin, size_t end) {
+        if (begin == end) return nullptr;
+        size_t mid = begin + (end - begin) / 2;
+        AVLNode* node = new AVLNode(std::move(keys[mid]));
+        node->left = buildBalanced(keys, begin, mid);
+        node->right = buildBalanced(keys, mid + 1, end);
+        updateHeight(node);
+        return node;
     }
 
-    void insert(TTNode* node, const std::string& value) {
-        if (node->isLeaf()) {
-            insertIntoNode(node, value, nullptr, nullptr);
-            if (node->hasTwoKeys()) split(node);
+    void extractInorder(AVLNode* node, std::vector<std::string>& out) {
+        if (node) {
+            extractInorder(node->left, out);
+            out.push_back(std::move(node->data));
+            extractInorder(node->right, out);
+            delete node;
+        }
+    }
+
+    bool fingerCovers(size_t level, const std::string& value) {
+        return (!fingerLower[level] || !(value < *fingerLower[level])) &&
+            (!fingerUpper[level] || value < *fingerUpper[level]);
+    }
+
+    void extendFinger(size_t level, const std::string& value) {
+        fingerPath.resize(level + 1);
+        fingerLower.resize(level + 1);
+        fingerUpper.resize(level + 1);
+        AVLNode* node = fingerPath[level];
+        while (true) {
+            const std::string* lower = fingerLower.back();
+            const std::string* upper = fingerUpper.back();
+            AVLNode* next;
+            if (value < node->data) {
+                next = node->left;
+                upper = &node->data;
+            }
+            else {
+                next = node->right;
+                lower = &node->data;
+            }
+            if (!next) return;
+            fingerPath.push_back(next);
+            fingerLower.push_back(lower);
+            fingerUpper.push_back(upper);
+            node = next;
+        }
+    }
+
+    void addWithFinger(const std::string& value) {
+        if (!root) {
+            root = new AVLNode(value);
+            fingerPath.clear();
+            return;
+        }
+        if (fingerPath.empty() || fingerPath[0] != root) {
+            fingerPath.assign(1, root);
+            fingerLower.assign(1, nullptr);
+            fingerUpper.assign(1, nullptr);
+        }
+
+        size_t level = fingerPath.size() - 1;
+        while (level > 0 && !fingerCovers(level, value)) {
+            level--;
+        }
+
+        int previousHeight = fingerPath[level]->height;
+        AVLNode* subtree = add(fingerPath[level], value);
+        while (level > 0 && (subtree != fingerPath[level] || subtree->height != previousHeight)) {
+            AVLNode* parent = fingerPath[level - 1];
+            if (parent->left == fingerPath[level]) {
+                parent->left = subtree;
+            }
+            else {
+                parent->right = subtree;
+            }
+            previousHeight = parent->height;
+            subtree = balance(parent);
+            level--;
+        }
+        if (level == 0) root = subtree;
+        fingerPath[level] = subtree;
+        extendFinger(level, value);
+    }
+
+public:
+    AVLTree() : root(nullptr), fingerEnabled(false) {}
+
+    ~AVLTree() {
+        deleteTree(root);
+    }
+
+    void deleteTree(AVLNode* node) {
+        if (node) {
+            deleteTree(node->left);
+            deleteTree(node->right);
+            delete node;
+        }
+    }
+
+    void setFinger(bool enabled) {
+        fingerEnabled = enabled;
+        fingerPath.clear();
+    }
+
+    void add(std::string value) {
+        if (fingerEnabled) {
+            addWithFinger(value);
+        }
+        else {
+            root = add(root, value);
+        }
+        if (bloom.enabled()) {
+            bloom.insert(value);
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
+    }
+
+    void remove(std::string value) {
+        root = remove(root, value);
+        fingerPath.clear();
+        if (bloom.enabled()) {
+            bloom.noteRemove();
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
+    }
+
+    bool search(std::string value) {
+        if (bloom.enabled() && !bloom.mayContain(value)) return false;
+        return search(root, value);
+    }
+
+    void print() {
+        inorder(root);
+        std::cout << std::endl;
+    }
+
+    void fillRandom(int n) {
+        for (int i = 0; i < n; i++) {
+            add(generateRandomString());
+        }
+    }
+
+    void enableBloom(bool enabled) {
+        if (enabled) {
+            rebuildBloom();
+        }
+        else {
+            bloom.disable();
+        }
+    }
+
+    const BloomFilter& bloomFilter() const {
+        return bloom;
+    }
+
+    void assignSorted(std::vector<std::string>& keys) {
+        deleteTree(root);
+        root = buildBalanced(keys, 0, keys.size());
+        resetDerivedState();
+    }
+
+    void extractSorted(std::vector<std::string>& keys) {
+        keys.clear();
+        extractInorder(root, keys);
+        root = nullptr;
+        resetDerivedState();
+    }
+
+    void join(std::string key, AVLTree& right) {
+        if (&right == this) return;
+        root = join(root, new AVLNode(key), right.root);
+        right.root = nullptr;
+        resetDerivedState();
+        right.resetDerivedState();
+    }
+
+    bool split(std::string key, AVLTree& left, AVLTree& right) {
+        AVLNode* leftRoot = nullptr;
+        AVLNode* rightRoot = nullptr;
+        AVLNode* found = split(root, key, leftRoot, rightRoot);
+        root = nullptr;
+        delete found;
+        left.deleteTree(left.root);
+        left.root = leftRoot;
+        right.deleteTree(right.root);
+        right.root = rightRoot;
+        resetDerivedState();
+        left.resetDerivedState();
+        right.resetDerivedState();
+        return found != nullptr;
+    }
+
+    void unionWith(AVLTree& other, unsigned threads = std::thread::hardware_concurrency()) {
+        if (&other == this) return;
+        root = unionWith(root, other.root, forkDepth(threads));
+        other.root = nullptr;
+        resetDerivedState();
+        other.resetDerivedState();
+    }
+
+    void intersect(AVLTree& other, unsigned threads = std::thread::hardware_concurrency()) {
+        if (&other == this) return;
+        root = intersect(root, other.root, forkDepth(threads));
+        other.root = nullptr;
+        resetDerivedState();
+        other.resetDerivedState();
+    }
+
+    void difference(AVLTree& other, unsigned threads = std::thread::hardware_concurrency()) {
+        if (&other == this) {
+            deleteTree(root);
+            root = nullptr;
+            resetDerivedState();
+            return;
+        }
+        root = difference(root, other.root, forkDepth(threads));
+        other.root = nullptr;
+        resetDerivedState();
+        other.resetDerivedState();
+    }
+};
+
+
+struct PAVLNode {
+    std::string data;
+    std::shared_ptr<const PAVLNode> left;
+    std::shared_ptr<const PAVLNode> right;
+    int height;
+    PAVLNode(std::string value, std::shared_ptr<const PAVLNode> l, std::shared_ptr<const PAVLNode> r)
+        : data(value), left(l), right(r), height(1 + std::max(l ? l->height : 0, r ? r->height : 0)) {}
+};
+
+typedef std::shared_ptr<const PAVLNode> PAVLRef;
+
+class AVLSnapshot {
+private:
+    PAVLRef root;
+
+    void inorder(const PAVLNode* node) const {
+        if (node) {
+            inorder(node->left.get());
+            std::cout << node->data << " ";
+            inorder(node->right.get());
+        }
+    }
+
+public:
+    AVLSnapshot(PAVLRef version) : root(version) {}
+
+    bool search(const std::string& value) const {
+        const PAVLNode* node = root.get();
+        while (node) {
+            if (node->data == value) return true;
+            node = value < node->data ? node->left.get() : node->right.get();
+        }
+        return false;
+    }
+
+    void print() const {
+        inorder(root.get());
+        std::cout << std::endl;
+    }
+};
+
+class PersistentAVLTree {
+private:
+#if defined(_MSVC_STL_VERSION) && defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<PAVLRef> root;
+
+    PAVLRef loadRoot() const {
+        return root.load();
+    }
+
+    void storeRoot(PAVLRef version) {
+        root.store(std::move(version));
+    }
+#else
+    PAVLRef root;
+
+    PAVLRef loadRoot() const {
+        return std::atomic_load(&root);
+    }
+
+    void storeRoot(PAVLRef version) {
+        std::atomic_store(&root, std::move(version));
+    }
+#endif
+    std::mutex writeMutex;
+
+    int height(const PAVLRef& node) {
+        return node ? node->height : 0;
+    }
+
+    PAVLRef make(const std::string& data, PAVLRef left, PAVLRef right) {
+        return std::make_shared<const PAVLNode>(data, left, right);
+    }
+
+    PAVLRef balance(const std::string& data, PAVLRef left, PAVLRef right) {
+        if (height(left) - height(right) == 2) {
+            if (height(left->left) < height(left->right)) {
+                PAVLRef pivot = left->right;
+                return make(pivot->data, make(left->data, left->left, pivot->left), make(data, pivot->right, right));
+            }
+            return make(left->data, left->left, make(data, left->right, right));
+        }
+        if (height(right) - height(left) == 2) {
+            if (height(right->right) < height(right->left)) {
+                PAVLRef pivot = right->left;
+                return make(pivot->data, make(data, left, pivot->left), make(right->data, pivot->right, right->right));
+            }
+            return make(right->data, make(data, left, right->left), right->right);
+        }
+        return make(data, left, right);
+    }
+
+    PAVLRef add(const PAVLRef& node, const std::string& value) {
+        if (!node) return make(value, nullptr, nullptr);
+        if (value < node->data) {
+            return balance(node->data, add(node->left, value), node->right);
+        }
+        return balance(node->data, node->left, add(node->right, value));
+    }
+
+    PAVLRef removeMin(const PAVLRef& node) {
+        if (!node->left) return node->right;
+        return balance(node->data, removeMin(node->left), node->right);
+    }
+
+    PAVLRef remove(const PAVLRef& node, const std::string& value) {
+        if (!node) return nullptr;
+        if (value < node->data) {
+            PAVLRef left = remove(node->left, value);
+            if (left == node->left) return node;
+            return balance(node->data, left, node->right);
+        }
+        if (value > node->data) {
+            PAVLRef right = remove(node->right, value);
+            if (right == node->right) return node;
+            return balance(node->data, node->left, right);
+        }
+        if (!node->left) return node->right;
+        if (!node->right) return node->left;
+        const PAVLNode* minNode = node->right.get();
+        while (minNode->left) {
+            minNode = minNode->left.get();
+        }
+        return balance(minNode->data, node->left, removeMin(node->right));
+    }
+
+public:
+    void add(std::string value) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        storeRoot(add(loadRoot(), value));
+    }
+
+    void remove(std::string value) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        storeRoot(remove(loadRoot(), value));
+    }
+
+    AVLSnapshot snapshot() const {
+        return AVLSnapshot(loadRoot());
+    }
+
+    bool search(std::string value) {
+        return snapshot().search(value);
+    }
+
+    void print() {
+        snapshot().print();
+    }
+
+    void fillRandom(int n) {
+        for (int i = 0; i < n; i++) {
+            add(generateRandomString());
+        }
+    }
+};
+
+
+struct TTNode {
+    std::string data1, data2;
+    TTNode* left;
+    TTNode* middle;
+    TTNode* right;
+    TTNode* parent;
+
+    TTNode(std::string value) : data1(value), left(nullptr), middle(nullptr), right(nullptr), parent(nullptr) {}
+
+    bool isLeaf() {
+        return left == nullptr && middle == nullptr && right == nullptr;
+    }
+
+    bool hasTwoKeys() {
+        return !data2.empty();
+    }
+
+    bool hasOneKey() {
+        return !data1.empty() && data2.empty();
+    }
+};
+
+class TwoThreeTree {
+private:
+    TTNode* root;
+    BloomFilter bloom;
+    bool fingerEnabled;
+    std::vector<TTNode*> fingerPath;
+    std::vector<const std::string*> fingerLower;
+    std::vector<const std::string*> fingerUpper;
+
+    template <typename F>
+    void forEachKey(TTNode* node, F& visit) {
+        if (node) {
+            forEachKey(node->left, visit);
+            visit(node->data1);
+            forEachKey(node->middle, visit);
+            if (!node->data2.empty()) {
+                visit(node->data2);
+                forEachKey(node->right, visit);
+            }
+        }
+    }
+
+    void rebuildBloom() {
+        bloom.rebuild([this](auto& visit) { forEachKey(root, visit); });
+    }
+
+    TTNode*& child(TTNode* node, int index) {
+        if (index == 0) return node->left;
+        if (index == 1) return node->middle;
+        return node->right;
+    }
+
+    std::string& key(TTNode* node, int index) {
+        return index == 0 ? node->data1 : node->data2;
+    }
+
+    void attach(TTNode* node, TTNode* childNode) {
+        if (childNode) childNode->parent = node;
+    }
+
+    bool insert(TTNode* node, const std::string& value, std::string& promoted, TTNode*& sibling) {
+        if (node->isLeaf()) {
+            if (!node->hasTwoKeys()) {
+                if (value < node->data1) {
+                    node->data2 = node->data1;
+                    node->data1 = value;
+                }
+                else {
+                    node->data2 = value;
+                }
+                return false;
+            }
+            std::string keys[3] = { node->data1, node->data2, value };
+            std::sort(keys, keys + 3);
+            node->data1 = keys[0];
+            node->data2.clear();
+            promoted = keys[1];
+            sibling = new TTNode(keys[2]);
+            return true;
+        }
+
+        int index = childIndex(value, node);
+        std::string childPromoted;
+        TTNode* childSibling = nullptr;
+        if (!insert(child(node, index), value, childPromoted, childSibling)) return false;
+        return absorb(node, index, childPromoted, childSibling, promoted, sibling);
+    }
+
+    int childIndex(const std::string& value, TTNode* node) {
+        if (value < node->data1) return 0;
+        if (!node->hasTwoKeys() || value < node->data2) return 1;
+        return 2;
+    }
+
+    bool absorb(TTNode* node, int index, const std::string& childPromoted, TTNode* childSibling,
+        std::string& promoted, TTNode*& sibling) {
+        int keyCount = node->hasTwoKeys() ? 2 : 1;
+        std::string keys[3];
+        TTNode* children[4];
+        for (int i = 0, k = 0; i < keyCount; i++) {
+            if (i == index) keys[k++] = childPromoted;
+            keys[k++] = key(node, i);
+        }
+        if (index == keyCount) keys[keyCount] = childPromoted;
+        for (int i = 0, c = 0; i <= keyCount; i++) {
+            children[c++] = child(node, i);
+            if (i == index) children[c++] = childSibling;
+        }
+
+        if (keyCount == 1) {
+            node->data1 = keys[0];
+            node->data2 = keys[1];
+            node->left = children[0];
+            node->middle = children[1];
+            node->right = children[2];
+            attach(node, childSibling);
+            return false;
+        }
+
+        node->data1 = keys[0];
+        node->data2.clear();
+        node->left = children[0];
+        node->middle = children[1];
+        node->right = nullptr;
+        attach(node, children[0]);
+        attach(node, children[1]);
+
+        sibling = new TTNode(keys[2]);
+        sibling->left = children[2];
+        sibling->middle = children[3];
+        attach(sibling, children[2]);
+        attach(sibling, children[3]);
+        promoted = keys[1];
+        return true;
+    }
+
+    TTNode* findMin(TTNode* node) {
+        while (!node->isLeaf()) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    void removeKeyAndChild(TTNode* node, int keyIndex, int childIndex) {
+        if (keyIndex == 0) {
+            node->data1 = node->data2;
+        }
+        node->data2.clear();
+        for (int i = childIndex; i < 2; i++) {
+            child(node, i) = child(node, i + 1);
+        }
+        node->right = nullptr;
+    }
+
+    void fixChild(TTNode* node, int index) {
+        TTNode* empty = child(node, index);
+        int keyCount = node->hasTwoKeys() ? 2 : 1;
+
+        if (index > 0 && child(node, index - 1)->hasTwoKeys()) {
+            TTNode* sibling = child(node, index - 1);
+            empty->data1 = key(node, index - 1);
+            key(node, index - 1) = sibling->data2;
+            sibling->data2.clear();
+            empty->middle = empty->left;
+            empty->left = sibling->right;
+            sibling->right = nullptr;
+            attach(empty, empty->left);
+            return;
+        }
+        if (index < keyCount && child(node, index + 1)->hasTwoKeys()) {
+            TTNode* sibling = child(node, index + 1);
+            empty->data1 = key(node, index);
+            key(node, index) = sibling->data1;
+            sibling->data1 = sibling->data2;
+            sibling->data2.clear();
+            empty->middle = sibling->left;
+            sibling->left = sibling->middle;
+            sibling->middle = sibling->right;
+            sibling->right = nullptr;
+            attach(empty, empty->middle);
+            return;
+        }
+
+        if (index > 0) {
+            TTNode* sibling = child(node, index - 1);
+            sibling->data2 = key(node, index - 1);
+            sibling->right = empty->left;
+            attach(sibling, sibling->right);
+            delete empty;
+            removeKeyAndChild(node, index - 1, index);
+        }
+        else {
+            TTNode* sibling = child(node, 1);
+            sibling->data2 = sibling->data1;
+            sibling->data1 = node->data1;
+            sibling->right = sibling->middle;
+            sibling->middle = sibling->left;
+            sibling->left = empty->left;
+            attach(sibling, sibling->left);
+            delete empty;
+            removeKeyAndChild(node, 0, 0);
+        }
+    }
+
+    bool remove(TTNode* node, const std::string& value) {
+        if (node->isLeaf()) {
+            if (node->data1 == value) {
+                node->data1 = node->data2;
+                node->data2.clear();
+            }
+            else if (node->hasTwoKeys() && node->data2 == value) {
+                node->data2.clear();
+            }
+            return node->data1.empty();
+        }
+
+        int index;
+        std::string target = value;
+        if (node->data1 == value) {
+            node->data1 = findMin(node->middle)->data1;
+            target = node->data1;
+            index = 1;
+        }
+        else if (node->hasTwoKeys() && node->data2 == value) {
+            node->data2 = findMin(node->right)->data1;
+            target = node->data2;
+            index = 2;
+        }
+        else if (value < node->data1) {
+            index = 0;
+        }
+        else if (!node->hasTwoKeys() || value < node->data2) {
+            index = 1;
+        }
+        else {
+            index = 2;
+        }
+
+        if (remove(child(node, index), target)) {
+            fixChild(node, index);
+        }
+        return node->data1.empty();
+    }
+
+    bool search(TTNode* node, const std::string& value) {
+        if (!node) return false;
+        if (node->data1 == value || node->data2 == value) return true;
+        if (value < node->data1) {
+            return search(node->left, value);
+        }
+        else if (node->data2.empty() || value < node->data2) {
+            return search(node->middle, value);
+        }
+        else {
+            return search(node->right, value);
+        }
+    }
+
+    void inorder(TTNode* node) {
+        if (node) {
+            inorder(node->left);
+            std::cout << node->data1 << " ";
+            inorder(node->middle);
+            if (!node->data2.empty()) {
+                std::cout << node->data2 << " ";
+                inorder(node->right);
+            }
+        }
+    }
+
+    void growRoot(const std::string& promoted, TTNode* sibling) {
+        TTNode* newRoot = new TTNode(promoted);
+        newRoot->left = root;
+        newRoot->middle = sibling;
+        attach(newRoot, root);
+        attach(newRoot, sibling);
+        root = newRoot;
+    }
+
+    bool fingerCovers(size_t level, const std::string& value) {
+        return (!fingerLower[level] || !(value < *fingerLower[level])) &&
+            (!fingerUpper[level] || value < *fingerUpper[level]);
+    }
+
+    void extendFinger(size_t level, const std::string& value) {
+        fingerPath.resize(level + 1);
+        fingerLower.resize(level + 1);
+        fingerUpper.resize(level + 1);
+        TTNode* node = fingerPath[level];
+        while (!node->isLeaf()) {
+            const std::string* lower = fingerLower.back();
+            const std::string* upper = fingerUpper.back();
+            int index = childIndex(value, node);
+            if (index > 0) lower = &key(node, index - 1);
+            if (index < (node->hasTwoKeys() ? 2 : 1)) upper = &key(node, index);
+            node = child(node, index);
+            fingerPath.push_back(node);
+            fingerLower.push_back(lower);
+            fingerUpper.push_back(upper);
+        }
+    }
+
+    void addWithFinger(const std::string& value) {
+        if (fingerPath.empty() || fingerPath[0] != root) {
+            fingerPath.assign(1, root);
+            fingerLower.assign(1, nullptr);
+            fingerUpper.assign(1, nullptr);
+        }
+
+        size_t level = fingerPath.size() - 1;
+        while (level > 0 && !fingerCovers(level, value)) {
+            level--;
+        }
+
+        std::string promoted;
+        TTNode* sibling = nullptr;
+        bool split = insert(fingerPath[level], value, promoted, sibling);
+        while (split && level > 0) {
+            TTNode* parent = fingerPath[level - 1];
+            int index = parent->left == fingerPath[level] ? 0 : parent->middle == fingerPath[level] ? 1 : 2;
+            std::string childPromoted = promoted;
+            split = absorb(parent, index, childPromoted, sibling, promoted, sibling);
+            level--;
+        }
+        if (split) {
+            growRoot(promoted, sibling);
+            fingerPath.assign(1, root);
+            fingerLower.assign(1, nullptr);
+            fingerUpper.assign(1, nullptr);
+        }
+        extendFinger(level, value);
+    }
+
+public:
+    TwoThreeTree() : root(nullptr), fingerEnabled(false) {}
+
+    ~TwoThreeTree() {
+        deleteTree(root);
+    }
+
+    void deleteTree(TTNode* node) {
+        if (node) {
+            deleteTree(node->left);
+            deleteTree(node->middle);
+            deleteTree(node->right);
+            delete node;
+        }
+    }
+
+    void add(std::string value) {
+        if (root == nullptr) {
+            root = new TTNode(value);
+        }
+        else if (fingerEnabled) {
+            addWithFinger(value);
+        }
+        else {
+            std::string promoted;
+            TTNode* sibling = nullptr;
+            if (insert(root, value, promoted, sibling)) {
+                growRoot(promoted, sibling);
+            }
+        }
+        if (bloom.enabled()) {
+            bloom.insert(value);
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
+    }
+
+    void setFinger(bool enabled) {
+        fingerEnabled = enabled;
+        fingerPath.clear();
+    }
+
+    void remove(std::string value) {
+        fingerPath.clear();
+        if (bloom.enabled()) {
+            bloom.noteRemove();
+            if (bloom.needsRebuild()) rebuildBloom();
+        }
+        if (root == nullptr) return;
+        if (remove(root, value)) {
+            TTNode* oldRoot = root;
+            root = root->left;
+            if (root) root->parent = nullptr;
+            delete oldRoot;
+        }
+    }
+
+    bool search(std::string value) {
+        if (bloom.enabled() && !bloom.mayContain(value)) return false;
+        return search(root, value);
+    }
+
+    void print() {
+        inorder(root);
+        std::cout << std::endl;
+    }
+
+    void fillRandom(int n) {
+        for (int i = 0; i < n; i++) {
+            add(generateRandomString());
+        }
+    }
+
+    void enableBloom(bool enabled) {
+        if (enabled) {
+            rebuildBloom();
+        }
+        else {
+            bloom.disable();
+        }
+    }
+
+    const BloomFilter& bloomFilter() const {
+        return bloom;
+    }
+};
+
+
+class AdaptiveSet {
+private:
+    std::vector<std::string> sorted;
+    AVLTree tree;
+    bool treeMode;
+    size_t count;
+    size_t opsSinceSwitch;
+    double recentWrites;
+    double recentReads;
+
+    static const size_t smallSize = 256;
+
+    void observe(bool write) {
+        recentWrites *= 0.999;
+        recentReads *= 0.999;
+        if (write) {
+            recentWrites += 1;
+        }
+        else {
+            recentReads += 1;
+        }
+        opsSinceSwitch++;
+        if (opsSinceSwitch < std::max<size_t>(count, 1024)) return;
+
+        double shiftsPerOp = count * recentWrites / (recentWrites + recentReads);
+        if (!treeMode && count >= smallSize && shiftsPerOp > 256) {
+            tree.assignSorted(sorted);
+            std::vector<std::string>().swap(sorted);
+            treeMode = true;
+            opsSinceSwitch = 0;
+        }
+        else if (treeMode && (count < smallSize / 2 || shiftsPerOp < 32)) {
+            tree.extractSorted(sorted);
+            treeMode = false;
+            opsSinceSwitch = 0;
+        }
+    }
+
+public:
+    AdaptiveSet() : treeMode(false), count(0), opsSinceSwitch(0), recentWrites(0), recentReads(0) {}
+
+    bool usesTree() const {
+        return treeMode;
+    }
+
+    void add(std::string value) {
+        if (treeMode) {
+            tree.add(value);
+        }
+        else {
+            sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+        }
+        count++;
+        observe(true);
+    }
+
+    void remove(std::string value) {
+        if (treeMode) {
+            if (tree.search(value)) {
+                tree.remove(value);
+                count--;
+            }
+        }
+        else {
+            auto it = std::lower_bound(sorted.begin(), sorted.end(), value);
+            if (it != sorted.end() && *it == value) {
+                sorted.erase(it);
+                count--;
+            }
+        }
+        observe(true);
+    }
+
+    bool search(std::string value) {
+        bool found = treeMode ? tree.search(value) : std::binary_search(sorted.begin(), sorted.end(), value);
+        observe(false);
+        return found;
+    }
+
+    void print() {
+        if (treeMode) {
+            tree.print();
+            return;
+        }
+        for (const auto& val : sorted) {
+            std::cout << val << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    void fillRandom(int n) {
+        for (int i = 0; i < n; i++) {
+            add(generateRandomString());
         }
-        else {
-            if (value < node->data1) {
-                insert(node->left, value);
-            }
-            else if (!node->data2.empty() && value < node->data2) {
-                insert(node->middle, value);
-            }
-            else {
-                insert(node->right, value);
+    }
+};
+
+
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
             }
+            task();
         }
     }
 
-    TTNode* findMin(TTNode* node) {
-        while (!node->isLeaf()) {
-            node = node->left;
+public:
+    ThreadPool(size_t threads) : stopping(false) {
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
         }
-        return node;
     }
 
-    void merge(TTNode* parent, TTNode* left, TTNode* right) {
-        if (parent->data1 == left->data1) {
-            parent->data1 = parent->data2;
-            parent->data2.clear();
-            parent->left = right;
-            parent->middle = nullptr;
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
-        else {
-            parent->data2.clear();
-            parent->middle = nullptr;
-            parent->right = right;
+        condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
         }
+    }
 
-        delete left;
+    template <typename F>
+    auto submit(F task) -> std::future<decltype(task())> {
+        auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(task);
+        auto result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push([packaged] { (*packaged)(); });
+        }
+        condition.notify_one();
+        return result;
     }
+};
 
-    void fix(TTNode* node) {
-        if (node->parent == nullptr) {
-            if (node->left && node->left->hasOneKey()) {
-                TTNode* left = node->left;
-                TTNode* right = node->middle;
+template <typename F>
+auto dispatch(ThreadPool* pool, F task) -> std::future<decltype(task())> {
+    if (pool) return pool->submit(task);
+    std::packaged_task<decltype(task())()> inlineTask(task);
+    auto result = inlineTask.get_future();
+    inlineTask();
+    return result;
+}
 
-                node->data1 = right->data1;
-                node->left = left->left;
-                node->middle = left->middle;
-                node->right = right->middle;
+template <typename T>
+void waitAll(std::vector<std::future<T>>& pending) {
+    for (auto& result : pending) {
+        result.get();
+    }
+    pending.clear();
+}
 
-                delete left;
-                delete right;
-            }
-            return;
-        }
 
-        TTNode* parent = node->parent;
+enum class TraceOp : unsigned char {
+    Add = 1,
+    Remove = 2,
+    Search = 3
+};
 
-        if (parent->left == node) {
-            TTNode* sibling = parent->middle;
+struct TraceEntry {
+    TraceOp op;
+    std::string key;
+};
 
-            if (sibling->hasTwoKeys()) {
-                node->data1 = parent->data1;
-                parent->data1 = sibling->data1;
-                sibling->data1 = sibling->data2;
-                sibling->data2.clear();
+class TraceRecorder {
+private:
+    std::ofstream out;
+    unsigned long long count;
 
-                node->middle = sibling->left;
-                sibling->left = sibling->middle;
-                sibling->middle = sibling->right;
-                sibling->right = nullptr;
-            }
-            else {
-                merge(parent, node, sibling);
-                fix(parent);
-            }
+    void writeVarint(unsigned long long value) {
+        while (value >= 0x80) {
+            out.put(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
         }
-        else if (parent->middle == node) {
-            TTNode* sibling = parent->left;
-
-            if (sibling->hasTwoKeys()) {
-                node->data1 = parent->data1;
-                parent->data1 = sibling->data2;
-                sibling->data2.clear();
+        out.put(static_cast<char>(value));
+    }
 
-                node->middle = node->left;
-                node->left = sibling->right;
-                sibling->right = nullptr;
-            }
-            else {
-                merge(parent, sibling, node);
-                fix(parent);
-            }
+    void writeCount() {
+        out.seekp(8);
+        for (int i = 0; i < 8; i++) {
+            out.put(static_cast<char>((count >> (8 * i)) & 0xFF));
         }
-        else {
-            TTNode* sibling = parent->middle;
+        out.seekp(0, std::ios::end);
+    }
 
-            if (sibling->hasTwoKeys()) {
-                node->data1 = parent->data2;
-                parent->data2 = sibling->data2;
-                sibling->data2.clear();
+public:
+    TraceRecorder() : count(0) {}
 
-                node->middle = node->left;
-                node->left = sibling->right;
-                sibling->right = nullptr;
-            }
-            else {
-                merge(parent, sibling, node);
-                fix(parent);
-            }
-        }
+    ~TraceRecorder() {
+        close();
     }
 
-    void remove(TTNode* node, const std::string& value) {
-        if (node->isLeaf()) {
-            if (node->data1 == value) {
-                node->data1.clear();
-            }
-            else if (node->data2 == value) {
-                node->data2.clear();
-            }
-            fix(node);
+    bool open(const std::string& path) {
+        close();
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        count = 0;
+        out.write("L6TR", 4);
+        out.put(1);
+        out.put(0);
+        out.put(0);
+        out.put(0);
+        writeCount();
+        return true;
+    }
+
+    bool isOpen() const {
+        return out.is_open();
+    }
+
+    unsigned long long recorded() const {
+        return count;
+    }
+
+    void record(TraceOp op, const std::string& key) {
+        if (!out.is_open()) return;
+        out.put(static_cast<char>(op));
+        writeVarint(key.size());
+        out.write(key.data(), key.size());
+        count++;
+    }
+
+    void close() {
+        if (!out.is_open()) return;
+        writeCount();
+        out.close();
+    }
+};
+
+class MappedFile {
+private:
+    const unsigned char* bytes;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile(const std::string& path) : bytes(nullptr), length(0) {
+#ifdef _WIN32
+        mapping = nullptr;
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return;
+        bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (bytes) length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) return;
+        void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) return;
+        bytes = static_cast<const unsigned char*>(view);
+        length = static_cast<size_t>(info.st_size);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (bytes) munmap(const_cast<unsigned char*>(bytes), length);
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+bool loadTrace(const std::string& path, std::vector<TraceEntry>& entries) {
+    MappedFile file(path);
+    const unsigned char* p = file.data();
+    if (!p || file.size() < 16 || std::memcmp(p, "L6TR", 4) != 0 || p[4] != 1) return false;
+    const unsigned char* end = p + file.size();
+
+    unsigned long long count = 0;
+    for (int i = 0; i < 8; i++) {
+        count |= static_cast<unsigned long long>(p[8 + i]) << (8 * i);
+    }
+    p += 16;
+
+    entries.clear();
+    entries.reserve(static_cast<size_t>(std::min<unsigned long long>(count, file.size() / 2)));
+    for (unsigned long long i = 0; i < count; i++) {
+        if (p >= end || *p < static_cast<unsigned char>(TraceOp::Add) || *p > static_cast<unsigned char>(TraceOp::Search)) return false;
+        TraceOp op = static_cast<TraceOp>(*p++);
+        unsigned long long keyLength = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (p >= end || shift > 63) return false;
+            unsigned char byte = *p++;
+            keyLength |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
         }
-        else {
-            if (value < node->data1) {
-                remove(node->left, value);
-            }
-            else if (node->data2.empty() || value < node->data2) {
-                remove(node->middle, value);
-            }
-            else {
-                remove(node->right, value);
-            }
+        if (keyLength > static_cast<unsigned long long>(end - p)) return false;
+        entries.push_back({ op, std::string(reinterpret_cast<const char*>(p), static_cast<size_t>(keyLength)) });
+        p += keyLength;
+    }
+    return true;
+}
+
+template <typename Container>
+void replayTrace(const std::string& name, Container& container, const std::vector<TraceEntry>& entries) {
+    std::vector<long long> latencies;
+    latencies.reserve(entries.size());
+    size_t hits = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& entry : entries) {
+        auto opStart = std::chrono::steady_clock::now();
+        switch (entry.op) {
+        case TraceOp::Add:
+            container.add(entry.key);
+            break;
+        case TraceOp::Remove:
+            container.remove(entry.key);
+            break;
+        case TraceOp::Search:
+            if (container.search(entry.key)) hits++;
+            break;
         }
+        auto opEnd = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(opEnd - opStart).count());
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> duration = end - start;
+
+    std::cout << name << " replay: " << entries.size() << " ops in " << duration.count() << " seconds";
+    if (duration.count() > 0) {
+        std::cout << " (" << static_cast<long long>(entries.size() / duration.count()) << " ops/s)";
     }
+    std::cout << ", " << hits << " search hits\n";
+    if (latencies.empty()) return;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    std::cout << "    latency ns p50: " << percentile(0.50) << ", p90: " << percentile(0.90)
+        << ", p99: " << percentile(0.99) << ", p99.9: " << percentile(0.999)
+        << ", max: " << latencies.back() << "\n";
+}
 
-    bool search(TTNode* node, const std::string& value) {
-        if (!node) return false;
-        if (node->data1 == value || node->data2 == value) return true;
-        if (value < node->data1) {
-            return search(node->left, value);
+void replayAll(const std::string& path) {
+    std::vector<TraceEntry> entries;
+    if (!loadTrace(path, entries)) {
+        std::cout << "Could not read trace " << path << "\n";
+        return;
+    }
+
+    LinkedList linkedList;
+    ArrayList arrayList;
+    BinarySearchTree bst;
+    AVLTree avl;
+    TwoThreeTree tt;
+
+    replayTrace("LinkedList", linkedList, entries);
+    replayTrace("ArrayList", arrayList, entries);
+    replayTrace("BinarySearchTree", bst, entries);
+    replayTrace("AVLTree", avl, entries);
+    replayTrace("TwoThreeTree", tt, entries);
+}
+
+double fanOutFill(ThreadPool* pool, int n) {
+    LinkedList linkedList;
+    ArrayList arrayList;
+    BinarySearchTree bst;
+    AVLTree avl;
+    TwoThreeTree tt;
+
+    std::vector<std::future<void>> pending;
+    auto start = std::chrono::high_resolution_clock::now();
+    pending.push_back(dispatch(pool, [&] { linkedList.fillRandom(n); }));
+    pending.push_back(dispatch(pool, [&] { arrayList.fillRandom(n); }));
+    pending.push_back(dispatch(pool, [&] { bst.fillRandom(n); }));
+    pending.push_back(dispatch(pool, [&] { avl.fillRandom(n); }));
+    pending.push_back(dispatch(pool, [&] { tt.fillRandom(n); }));
+    waitAll(pending);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    return duration.count();
+}
+
+void benchmarkSetOperations() {
+    int m = 100000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "AVLTree set operations on two " << m << "-key sets, " << threads << " threads available\n";
+
+    for (int op = 0; op < 4; op++) {
+        AVLTree a, b;
+        a.fillRandom(m);
+        b.fillRandom(m);
+        auto start = std::chrono::high_resolution_clock::now();
+        if (op == 0) {
+            a.unionWith(b, 1);
         }
-        else if (node->data2.empty() || value < node->data2) {
-            return search(node->middle, value);
+        else if (op == 1) {
+            a.unionWith(b, threads);
+        }
+        else if (op == 2) {
+            a.intersect(b, threads);
         }
         else {
-            return search(node->right, value);
+            a.difference(b, threads);
         }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+        const char* names[] = { "unionWith (1 thread)", "unionWith", "intersect", "difference" };
+        std::cout << "AVLTree " << names[op] << ": " << duration.count() << " seconds\n";
     }
+}
 
-    void inorder(TTNode* node) {
-        if (node) {
-            inorder(node->left);
-            std::cout << node->data1 << " ";
-            inorder(node->middle);
-            if (!node->data2.empty()) {
-                std::cout << node->data2 << " ";
-                inorder(node->right);
+double snapshotReads(PersistentAVLTree& tree, const std::vector<std::string>& queries, int readers, bool withWriter) {
+    std::atomic<bool> stop(false);
+    std::atomic<long long> reads(0);
+    std::atomic<long long> hits(0);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r] {
+            long long local = 0;
+            long long localHits = 0;
+            size_t i = r;
+            while (!stop.load(std::memory_order_relaxed)) {
+                AVLSnapshot snapshot = tree.snapshot();
+                for (int k = 0; k < 64; k++) {
+                    if (snapshot.search(queries[i++ % queries.size()])) localHits++;
+                }
+                local += 64;
             }
-        }
+            reads += local;
+            hits += localHits;
+        });
+    }
+    if (withWriter) {
+        threads.emplace_back([&] {
+            size_t i = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                tree.add(queries[i % queries.size()]);
+                tree.remove(queries[(i + queries.size() / 2) % queries.size()]);
+                i++;
+            }
+        });
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    std::cout << "    " << hits.load() << " of " << reads.load() << " reads hit\n";
+    return reads.load() / duration.count();
+}
+
+void benchmarkSnapshots() {
+    int n = 100000;
+    int readers = 2;
+    PersistentAVLTree tree;
+    tree.fillRandom(n);
+    std::vector<std::string> queries;
+    for (int i = 0; i < 4096; i++) {
+        queries.push_back(generateRandomString());
     }
 
-public:
-    TwoThreeTree() : root(nullptr) {}
+    std::cout << "PersistentAVLTree snapshot reads with " << readers << " readers\n";
+    double alone = snapshotReads(tree, queries, readers, false);
+    std::cout << "PersistentAVLTree reads/s without writer: " << alone << "\n";
+    double contended = snapshotReads(tree, queries, readers, true);
+    std::cout << "PersistentAVLTree reads/s with writer: " << contended << "\n";
+}
 
-    ~TwoThreeTree() {
-        deleteTree(root);
+template <typename Container>
+double timeSearches(Container& container, const std::vector<std::string>& queries, size_t& hits) {
+    hits = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& query : queries) {
+        if (container.search(query)) hits++;
     }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    return duration.count();
+}
 
-    void deleteTree(TTNode* node) {
-        if (node) {
-            deleteTree(node->left);
-            deleteTree(node->middle);
-            deleteTree(node->right);
-            delete node;
-        }
+void benchmarkFrontCoding(ArrayList& arrayList, MemoryStats& plainMemory) {
+    std::vector<std::string> queries;
+    for (int i = 0; i < 100000; i++) {
+        queries.push_back(generateRandomString());
     }
 
-    void add(std::string value) {
-        if (root == nullptr) {
-            root = new TTNode(value);
+    {
+        MemoryScope scope(plainMemory);
+        arrayList.shrinkToFit();
+    }
+    size_t hits;
+    long long plainBytes = plainMemory.usableBytes.load();
+    double plain = timeSearches(arrayList, queries, hits);
+    std::cout << "ArrayList " << queries.size() << " searches: " << plain << " seconds, " << hits << " hits, "
+        << plainBytes << " bytes\n";
+
+    MemoryStats compressedMemory;
+    {
+        MemoryScope scope(compressedMemory);
+        arrayList.compress();
+    }
+    double compressed = timeSearches(arrayList, queries, hits);
+    std::cout << "ArrayList front-coded " << queries.size() << " searches: " << compressed << " seconds, " << hits << " hits, "
+        << compressedMemory.usableBytes.load() << " bytes\n";
+
+    arrayList.decompress();
+}
+
+template <typename Container>
+void benchmarkBloom(const std::string& name, Container& container, const std::vector<std::string>& queries) {
+    size_t hits;
+    container.enableBloom(false);
+    double plain = timeSearches(container, queries, hits);
+    std::vector<bool> present;
+    for (const auto& query : queries) {
+        present.push_back(container.search(query));
+    }
+
+    container.enableBloom(true);
+    double filtered = timeSearches(container, queries, hits);
+    size_t negatives = 0;
+    size_t falsePositives = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (present[i]) continue;
+        negatives++;
+        if (container.bloomFilter().mayContain(queries[i])) falsePositives++;
+    }
+
+    std::cout << name << " searches: " << plain << " seconds, with Bloom filter: " << filtered << " seconds";
+    if (filtered > 0) {
+        std::cout << " (" << plain / filtered << "x)";
+    }
+    std::cout << ", false positives " << (negatives ? 100.0 * falsePositives / negatives : 0.0) << "%, "
+        << container.bloomFilter().bytes() << " bytes\n";
+    container.enableBloom(false);
+}
+
+void benchmarkBloomFilters(LinkedList& linkedList, ArrayList& arrayList, BinarySearchTree& bst, AVLTree& avl, TwoThreeTree& tt) {
+    std::vector<std::string> queries;
+    for (int i = 0; i < 20000; i++) {
+        if (i % 10 == 0) {
+            queries.push_back(generateRandomString());
         }
         else {
-            insert(root, value);
+            queries.push_back(generateRandomString() + "-MISS");
         }
     }
+    std::cout << "Miss-heavy workload: " << queries.size() << " searches, 90% absent keys\n";
 
-    void remove(std::string value) {
-        if (root == nullptr) return;
-        remove(root, value);
-        if (root && root->data1.empty() && root->data2.empty()) {
-            TTNode* oldRoot = root;
-            if (root->left) {
-                root = root->left;
-                root->parent = nullptr;
-            }
-            else if (root->middle) {
-                root = root->middle;
-                root->parent = nullptr;
-            }
-            else if (root->right) {
-                root = root->right;
-                root->parent = nullptr;
-            }
-            else {
-                root = nullptr;
-            }
-            delete oldRoot;
+    benchmarkBloom("LinkedList", linkedList, queries);
+    benchmarkBloom("ArrayList", arrayList, queries);
+    benchmarkBloom("BinarySearchTree", bst, queries);
+    benchmarkBloom("AVLTree", avl, queries);
+    benchmarkBloom("TwoThreeTree", tt, queries);
+}
+
+template <typename Container>
+double runWorkload(Container& container, const std::vector<TraceEntry>& ops, size_t& hits) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& entry : ops) {
+        switch (entry.op) {
+        case TraceOp::Add:
+            container.add(entry.key);
+            break;
+        case TraceOp::Remove:
+            container.remove(entry.key);
+            break;
+        case TraceOp::Search:
+            if (container.search(entry.key)) hits++;
+            break;
         }
     }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    return duration.count();
+}
 
-    bool search(std::string value) {
-        return search(root, value);
+std::vector<TraceEntry> makePhase(int ops, int writePercent) {
+    std::vector<TraceEntry> phase;
+    std::mt19937& engine = randomEngine();
+    for (int i = 0; i < ops; i++) {
+        TraceOp op = TraceOp::Search;
+        if (static_cast<int>(engine() % 100) < writePercent) {
+            op = engine() % 3 ? TraceOp::Add : TraceOp::Remove;
+        }
+        phase.push_back({ op, generateRandomString() });
+    }
+    return phase;
+}
+
+template <typename Container>
+void benchmarkPhases(const std::string& name, const std::vector<std::vector<TraceEntry>>& phases) {
+    Container container;
+    size_t hits = 0;
+    double total = 0;
+    std::cout << name << " phases:";
+    for (const auto& phase : phases) {
+        double seconds = runWorkload(container, phase, hits);
+        total += seconds;
+        std::cout << " " << seconds;
     }
+    std::cout << ", total " << total << " seconds, " << hits << " hits\n";
+}
 
-    void print() {
-        inorder(root);
-        std::cout << std::endl;
+void benchmarkAdaptive() {
+    std::vector<std::vector<TraceEntry>> phases;
+    phases.push_back(makePhase(40000, 90));
+    phases.push_back(makePhase(400000, 0));
+    phases.push_back(makePhase(40000, 90));
+    phases.push_back(makePhase(400000, 0));
+    std::cout << "Phase-changing workload: 40000 ops 90% writes, 400000 reads, repeated\n";
+
+    benchmarkPhases<AdaptiveSet>("AdaptiveSet", phases);
+    benchmarkPhases<ArrayList>("ArrayList", phases);
+    benchmarkPhases<AVLTree>("AVLTree", phases);
+    benchmarkPhases<TwoThreeTree>("TwoThreeTree", phases);
+}
+
+template <typename Container>
+void benchmarkFingerFor(const std::string& name, const std::string& input, const std::vector<std::string>& keys) {
+    Container plain;
+    Container fingered;
+    fingered.setFinger(true);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& key : keys) {
+        plain.add(key);
     }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    std::cout << name << " " << keys.size() << " " << input << " inserts: " << duration.count() << " seconds";
 
-    void fillRandom(int n) {
-        for (int i = 0; i < n; i++) {
-            add(generateRandomString());
-        }
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto& key : keys) {
+        fingered.add(key);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    duration = end - start;
+    std::cout << ", with finger: " << duration.count() << " seconds\n";
+}
+
+void benchmarkFinger() {
+    std::vector<std::string> sorted;
+    for (int i = 0; i < 200000; i++) {
+        sorted.push_back(generateRandomString());
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<std::string> clustered = sorted;
+    for (size_t i = 0; i + 16 <= clustered.size(); i += 16) {
+        std::shuffle(clustered.begin() + i, clustered.begin() + i + 16, randomEngine());
+    }
+
+    std::vector<std::string> sortedSample, clusteredSample;
+    for (size_t i = 0; i < sorted.size(); i += 10) {
+        sortedSample.push_back(sorted[i]);
+        clusteredSample.push_back(clustered[i]);
+    }
+
+    benchmarkFingerFor<LinkedList>("LinkedList", "sorted", sortedSample);
+    benchmarkFingerFor<LinkedList>("LinkedList", "clustered", clusteredSample);
+    benchmarkFingerFor<AVLTree>("AVLTree", "sorted", sorted);
+    benchmarkFingerFor<AVLTree>("AVLTree", "clustered", clustered);
+    benchmarkFingerFor<TwoThreeTree>("TwoThreeTree", "sorted", sorted);
+    benchmarkFingerFor<TwoThreeTree>("TwoThreeTree", "clustered", clustered);
+}
+
+template <typename Container>
+void benchmarkBatchFor(const std::string& name, Container& container, const std::vector<std::string>& queries) {
+    size_t hits;
+    double single = timeSearches(container, queries, hits);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<bool> found = container.searchSorted(queries);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    size_t batchHits = std::count(found.begin(), found.end(), true);
+
+    std::cout << name << " batch of " << queries.size() << ": search " << single << " seconds, searchSorted "
+        << duration.count() << " seconds, " << hits << "/" << batchHits << " hits\n";
+}
+
+void benchmarkBatchSearch() {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 20000; i++) {
+        keys.push_back(generateRandomString());
+    }
+    std::sort(keys.begin(), keys.end());
+
+    LinkedList linkedList;
+    ArrayList arrayList;
+    linkedList.setFinger(true);
+    for (const auto& key : keys) {
+        linkedList.add(key);
+        arrayList.add(key);
     }
-};
 
+    for (int size = 10; size <= 10000; size *= 10) {
+        std::vector<std::string> queries;
+        for (int i = 0; i < size; i++) {
+            queries.push_back(generateRandomString());
+        }
+        benchmarkBatchFor("LinkedList", linkedList, queries);
+        benchmarkBatchFor("ArrayList", arrayList, queries);
+    }
+}
 
 void benchmark() {
+    MemoryStats linkedListMemory, arrayListMemory, bstMemory, avlMemory, ttMemory;
     LinkedList linkedList;
     ArrayList arrayList;
     BinarySearchTree bst;
@@ -732,34 +2750,69 @@ void benchmark() {
     std::cout << "Benchmarking with " << n << " elements...\n";
 
     auto start = std::chrono::high_resolution_clock::now();
-    linkedList.fillRandom(n);
+    {
+        MemoryScope scope(linkedListMemory);
+        linkedList.fillRandom(n);
+    }
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> duration = end - start;
     std::cout << "LinkedList fillRandom: " << duration.count() << " seconds\n";
+    printMemory(linkedListMemory, n);
 
     start = std::chrono::high_resolution_clock::now();
-    arrayList.fillRandom(n);
+    {
+        MemoryScope scope(arrayListMemory);
+        arrayList.fillRandom(n);
+    }
     end = std::chrono::high_resolution_clock::now();
     duration = end - start;
     std::cout << "ArrayList fillRandom: " << duration.count() << " seconds\n";
+    printMemory(arrayListMemory, n);
+    benchmarkFrontCoding(arrayList, arrayListMemory);
 
     start = std::chrono::high_resolution_clock::now();
-    bst.fillRandom(n);
+    {
+        MemoryScope scope(bstMemory);
+        bst.fillRandom(n);
+    }
     end = std::chrono::high_resolution_clock::now();
     duration = end - start;
     std::cout << "BinarySearchTree fillRandom: " << duration.count() << " seconds\n";
+    printMemory(bstMemory, n);
 
     start = std::chrono::high_resolution_clock::now();
-    avl.fillRandom(n);
+    {
+        MemoryScope scope(avlMemory);
+        avl.fillRandom(n);
+    }
     end = std::chrono::high_resolution_clock::now();
     duration = end - start;
     std::cout << "AVLTree fillRandom: " << duration.count() << " seconds\n";
+    printMemory(avlMemory, n);
 
     start = std::chrono::high_resolution_clock::now();
-    tt.fillRandom(n);
+    {
+        MemoryScope scope(ttMemory);
+        tt.fillRandom(n);
+    }
     end = std::chrono::high_resolution_clock::now();
     duration = end - start;
     std::cout << "TwoThreeTree fillRandom: " << duration.count() << " seconds\n";
+    printMemory(ttMemory, n);
+
+    benchmarkBloomFilters(linkedList, arrayList, bst, avl, tt);
+
+    int fanOut = 2000;
+    ThreadPool pool(5);
+    std::cout << "Fan-out fillRandom(" << fanOut << ") sequential: " << fanOutFill(nullptr, fanOut) << " seconds\n";
+    std::cout << "Fan-out fillRandom(" << fanOut << ") parallel: " << fanOutFill(&pool, fanOut) << " seconds\n";
+
+    benchmarkSetOperations();
+    benchmarkSnapshots();
+    benchmarkAdaptive();
+    benchmarkFinger();
+    benchmarkBatchSearch();
+    std::cout << "Peak RSS: " << peakResidentBytes() << " bytes\n";
 }
 
 void demo() {
@@ -806,46 +2859,63 @@ void demo() {
 }
 
 int main() {
-    srand(static_cast<unsigned int>(time(0)));
-
     LinkedList linkedList;
     ArrayList arrayList;
     BinarySearchTree bst;
     AVLTree avl;
     TwoThreeTree tt;
 
+    ThreadPool pool(5);
+    bool parallel = false;
+    bool bloom = false;
+    TraceRecorder recorder;
+
     int choice;
     std::string value;
+    std::vector<std::future<void>> pending;
+    std::vector<std::future<bool>> found;
     while (true) {
-        std::cout << "1. Add\n2. Remove\n3. Search\n4. Print\n5. Fill random\n6. Demo\n7. Benchmark\n8. Exit\n";
+        std::cout << "1. Add\n2. Remove\n3. Search\n4. Print\n5. Fill random\n6. Demo\n7. Benchmark\n8. Exit\n9. Toggle parallel mode\n10. Start/stop trace recording\n11. Replay trace\n12. Toggle Bloom filters\n";
         std::cin >> choice;
+        ThreadPool* executor = parallel ? &pool : nullptr;
         switch (choice) {
         case 1:
             std::cout << "Enter value to add: ";
             std::cin >> value;
-            linkedList.add(value);
-            arrayList.add(value);
-            bst.add(value);
-            avl.add(value);
-            tt.add(value);
+            recorder.record(TraceOp::Add, value);
+            pending.push_back(dispatch(executor, [&] { linkedList.add(value); }));
+            pending.push_back(dispatch(executor, [&] { arrayList.add(value); }));
+            pending.push_back(dispatch(executor, [&] { bst.add(value); }));
+            pending.push_back(dispatch(executor, [&] { avl.add(value); }));
+            pending.push_back(dispatch(executor, [&] { tt.add(value); }));
+            waitAll(pending);
             break;
         case 2:
             std::cout << "Enter value to remove: ";
             std::cin >> value;
-            linkedList.remove(value);
-            arrayList.remove(value);
-            bst.remove(value);
-            avl.remove(value);
-            tt.remove(value);
+            recorder.record(TraceOp::Remove, value);
+            pending.push_back(dispatch(executor, [&] { linkedList.remove(value); }));
+            pending.push_back(dispatch(executor, [&] { arrayList.remove(value); }));
+            pending.push_back(dispatch(executor, [&] { bst.remove(value); }));
+            pending.push_back(dispatch(executor, [&] { avl.remove(value); }));
+            pending.push_back(dispatch(executor, [&] { tt.remove(value); }));
+            waitAll(pending);
             break;
         case 3:
             std::cout << "Enter value to search: ";
             std::cin >> value;
-            std::cout << "LinkedList: " << (linkedList.search(value) ? "Found" : "Not found") << "\n";
-            std::cout << "ArrayList: " << (arrayList.search(value) ? "Found" : "Not found") << "\n";
-            std::cout << "BST: " << (bst.search(value) ? "Found" : "Not found") << "\n";
-            std::cout << "AVL: " << (avl.search(value) ? "Found" : "Not found") << "\n";
-            std::cout << "2-3 Tree: " << (tt.search(value) ? "Found" : "Not found") << "\n";
+            recorder.record(TraceOp::Search, value);
+            found.push_back(dispatch(executor, [&] { return linkedList.search(value); }));
+            found.push_back(dispatch(executor, [&] { return arrayList.search(value); }));
+            found.push_back(dispatch(executor, [&] { return bst.search(value); }));
+            found.push_back(dispatch(executor, [&] { return avl.search(value); }));
+            found.push_back(dispatch(executor, [&] { return tt.search(value); }));
+            std::cout << "LinkedList: " << (found[0].get() ? "Found" : "Not found") << "\n";
+            std::cout << "ArrayList: " << (found[1].get() ? "Found" : "Not found") << "\n";
+            std::cout << "BST: " << (found[2].get() ? "Found" : "Not found") << "\n";
+            std::cout << "AVL: " << (found[3].get() ? "Found" : "Not found") << "\n";
+            std::cout << "2-3 Tree: " << (found[4].get() ? "Found" : "Not found") << "\n";
+            found.clear();
             break;
         case 4:
             std::cout << "LinkedList: "; linkedList.print();
@@ -858,11 +2928,26 @@ int main() {
             int n;
             std::cout << "Enter number of random values: ";
             std::cin >> n;
-            linkedList.fillRandom(n);
-            arrayList.fillRandom(n);
-            bst.fillRandom(n);
-            avl.fillRandom(n);
-            tt.fillRandom(n);
+            if (recorder.isOpen()) {
+                std::vector<std::string> keys;
+                for (int i = 0; i < n; i++) {
+                    keys.push_back(generateRandomString());
+                    recorder.record(TraceOp::Add, keys.back());
+                }
+                pending.push_back(dispatch(executor, [&] { for (const auto& key : keys) linkedList.add(key); }));
+                pending.push_back(dispatch(executor, [&] { for (const auto& key : keys) arrayList.add(key); }));
+                pending.push_back(dispatch(executor, [&] { for (const auto& key : keys) bst.add(key); }));
+                pending.push_back(dispatch(executor, [&] { for (const auto& key : keys) avl.add(key); }));
+                pending.push_back(dispatch(executor, [&] { for (const auto& key : keys) tt.add(key); }));
+                waitAll(pending);
+                break;
+            }
+            pending.push_back(dispatch(executor, [&] { linkedList.fillRandom(n); }));
+            pending.push_back(dispatch(executor, [&] { arrayList.fillRandom(n); }));
+            pending.push_back(dispatch(executor, [&] { bst.fillRandom(n); }));
+            pending.push_back(dispatch(executor, [&] { avl.fillRandom(n); }));
+            pending.push_back(dispatch(executor, [&] { tt.fillRandom(n); }));
+            waitAll(pending);
             break;
         case 6:
             demo();
@@ -872,6 +2957,36 @@ int main() {
             break;
         case 8:
             return 0;
+        case 9:
+            parallel = !parallel;
+            std::cout << "Parallel mode: " << (parallel ? "on" : "off") << "\n";
+            break;
+        case 10:
+            if (recorder.isOpen()) {
+                std::cout << "Recorded " << recorder.recorded() << " operations\n";
+                recorder.close();
+                break;
+            }
+            std::cout << "Enter trace file to record: ";
+            std::cin >> value;
+            if (!recorder.open(value)) {
+                std::cout << "Could not open trace " << value << "\n";
+            }
+            break;
+        case 11:
+            std::cout << "Enter trace file to replay: ";
+            std::cin >> value;
+            replayAll(value);
+            break;
+        case 12:
+            bloom = !bloom;
+            linkedList.enableBloom(bloom);
+            arrayList.enableBloom(bloom);
+            bst.enableBloom(bloom);
+            avl.enableBloom(bloom);
+            tt.enableBloom(bloom);
+            std::cout << "Bloom filters: " << (bloom ? "on" : "off") << "\n";
+            break;
         }
     }
 